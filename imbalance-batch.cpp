@@ -0,0 +1,301 @@
+#include "imbalance-batch.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WOBI_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/*===========================================================
+ *   Kernels
+ *===========================================================*/
+
+// All kernels process `count` rows, which the caller rounds up to a multiple
+// of 8. Rows past size() hold stale but finite data and are never read back.
+typedef void (*ImbalanceKernel)(const double* bids, const double* asks,
+                                const double* weights, int levels, int count,
+                                double* out);
+typedef void (*TransitionKernel)(const double* imbalance, const int* in_pos,
+                                 const int* working_buy, int count,
+                                 double entry, double exit, int len,
+                                 int* persistence, int* action);
+
+void ImbalanceScalar(const double* bids, const double* asks,
+                     const double* weights, int levels, int count,
+                     double* out) {
+    const int stride = ImbalanceBatch::kCapacity;
+    for (int k = 0; k < count; ++k) {
+        double weighted_bids = 0.0;
+        double weighted_asks = 0.0;
+        double weighted_total = 0.0;
+        for (int i = 0; i < levels; ++i) {
+            const double b = bids[i * stride + k];
+            const double a = asks[i * stride + k];
+            weighted_bids += weights[i] * b;
+            weighted_asks += weights[i] * a;
+            weighted_total += weights[i] * (b + a);
+        }
+        out[k] = weighted_total == 0.0
+                     ? 0.0
+                     : (weighted_bids - weighted_asks) / weighted_total;
+    }
+}
+
+// Same rules as WobiSignalStrategy::EvaluateImbalanceSignal, written without
+// branches so it vectorizes across rows:
+//   - I > entry extends the streak, anything else resets it.
+//   - A streak reaching len fires (and resets); it only buys when flat with
+//     no working buy order.
+//   - When long, I < exit sells and resets the streak.
+inline void TransitionsBody(const double* imbalance, const int* in_pos,
+                            const int* working_buy, int count, double entry,
+                            double exit, int len, int* persistence,
+                            int* action) {
+    for (int k = 0; k < count; ++k) {
+        const int above = imbalance[k] > entry;
+        const int below = imbalance[k] < exit;
+
+        int p = above * (persistence[k] + 1);
+        const int fire = above & (p >= len);
+        const int buy = fire & (in_pos[k] ^ 1) & (working_buy[k] ^ 1);
+        const int sell = in_pos[k] & below;
+
+        p *= (fire | sell) ^ 1;
+        persistence[k] = p;
+        action[k] = buy * ImbalanceBatch::ACTION_BUY +
+                    sell * ImbalanceBatch::ACTION_SELL;
+    }
+}
+
+void TransitionsScalar(const double* imbalance, const int* in_pos,
+                       const int* working_buy, int count, double entry,
+                       double exit, int len, int* persistence, int* action) {
+    TransitionsBody(imbalance, in_pos, working_buy, count, entry, exit, len,
+                    persistence, action);
+}
+
+#ifdef WOBI_X86_KERNELS
+
+__attribute__((target("avx2"))) void ImbalanceAvx2(
+    const double* bids, const double* asks, const double* weights, int levels,
+    int count, double* out) {
+    const int stride = ImbalanceBatch::kCapacity;
+    const __m256d zero = _mm256_setzero_pd();
+    for (int k = 0; k < count; k += 4) {
+        __m256d weighted_bids = zero;
+        __m256d weighted_asks = zero;
+        __m256d weighted_total = zero;
+        for (int i = 0; i < levels; ++i) {
+            const __m256d w = _mm256_set1_pd(weights[i]);
+            const __m256d b = _mm256_loadu_pd(bids + i * stride + k);
+            const __m256d a = _mm256_loadu_pd(asks + i * stride + k);
+            weighted_bids = _mm256_add_pd(weighted_bids, _mm256_mul_pd(w, b));
+            weighted_asks = _mm256_add_pd(weighted_asks, _mm256_mul_pd(w, a));
+            weighted_total = _mm256_add_pd(
+                weighted_total, _mm256_mul_pd(w, _mm256_add_pd(b, a)));
+        }
+        const __m256d empty = _mm256_cmp_pd(weighted_total, zero, _CMP_EQ_OQ);
+        const __m256d imbalance = _mm256_div_pd(
+            _mm256_sub_pd(weighted_bids, weighted_asks), weighted_total);
+        _mm256_storeu_pd(out + k, _mm256_blendv_pd(imbalance, zero, empty));
+    }
+}
+
+__attribute__((target("avx2"))) void TransitionsAvx2(
+    const double* imbalance, const int* in_pos, const int* working_buy,
+    int count, double entry, double exit, int len, int* persistence,
+    int* action) {
+    TransitionsBody(imbalance, in_pos, working_buy, count, entry, exit, len,
+                    persistence, action);
+}
+
+__attribute__((target("avx512f"))) void ImbalanceAvx512(
+    const double* bids, const double* asks, const double* weights, int levels,
+    int count, double* out) {
+    const int stride = ImbalanceBatch::kCapacity;
+    const __m512d zero = _mm512_setzero_pd();
+    for (int k = 0; k < count; k += 8) {
+        __m512d weighted_bids = zero;
+        __m512d weighted_asks = zero;
+        __m512d weighted_total = zero;
+        for (int i = 0; i < levels; ++i) {
+            const __m512d w = _mm512_set1_pd(weights[i]);
+            const __m512d b = _mm512_loadu_pd(bids + i * stride + k);
+            const __m512d a = _mm512_loadu_pd(asks + i * stride + k);
+            weighted_bids = _mm512_add_pd(weighted_bids, _mm512_mul_pd(w, b));
+            weighted_asks = _mm512_add_pd(weighted_asks, _mm512_mul_pd(w, a));
+            weighted_total = _mm512_add_pd(
+                weighted_total, _mm512_mul_pd(w, _mm512_add_pd(b, a)));
+        }
+        const __mmask8 nonempty =
+            _mm512_cmp_pd_mask(weighted_total, zero, _CMP_NEQ_UQ);
+        _mm512_storeu_pd(
+            out + k,
+            _mm512_maskz_div_pd(nonempty,
+                                _mm512_sub_pd(weighted_bids, weighted_asks),
+                                weighted_total));
+    }
+}
+
+__attribute__((target("avx512f"))) void TransitionsAvx512(
+    const double* imbalance, const int* in_pos, const int* working_buy,
+    int count, double entry, double exit, int len, int* persistence,
+    int* action) {
+    TransitionsBody(imbalance, in_pos, working_buy, count, entry, exit, len,
+                    persistence, action);
+}
+
+#endif  // WOBI_X86_KERNELS
+
+struct Kernels {
+    ImbalanceKernel imbalance;
+    TransitionKernel transitions;
+    const char* name;
+};
+
+// Fills *kernels with the named kernel set if this CPU can run it.
+bool KernelsByName(const std::string& name, Kernels* kernels) {
+    if (name == "scalar") {
+        const Kernels scalar = {ImbalanceScalar, TransitionsScalar, "scalar"};
+        *kernels = scalar;
+        return true;
+    }
+#ifdef WOBI_X86_KERNELS
+    __builtin_cpu_init();
+    if (name == "avx512" && __builtin_cpu_supports("avx512f")) {
+        const Kernels avx512 = {ImbalanceAvx512, TransitionsAvx512, "avx512"};
+        *kernels = avx512;
+        return true;
+    }
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) {
+        const Kernels avx2 = {ImbalanceAvx2, TransitionsAvx2, "avx2"};
+        *kernels = avx2;
+        return true;
+    }
+#endif
+    return false;
+}
+
+Kernels SelectKernels() {
+    Kernels kernels;
+    if (!KernelsByName("avx512", &kernels) &&
+        !KernelsByName("avx2", &kernels)) {
+        KernelsByName("scalar", &kernels);
+    }
+    return kernels;
+}
+
+Kernels& ActiveKernels() {
+    static Kernels kernels = SelectKernels();
+    return kernels;
+}
+
+}  // namespace
+
+/*===========================================================
+ *   ImbalanceBatch
+ *===========================================================*/
+
+const int ImbalanceBatch::kCapacity;
+
+ImbalanceBatch::ImbalanceBatch()
+    : m_num_levels(0),
+      m_weight_exponent(1.0),
+      m_size(0),
+      m_imbalance(kCapacity, 0.0),
+      m_persistence(kCapacity, 0),
+      m_in_position(kCapacity, 0),
+      m_working_buy(kCapacity, 0),
+      m_action(kCapacity, ACTION_NONE),
+      m_prev_row(kCapacity, -1) {
+    m_chained.reserve(kCapacity);
+}
+
+void ImbalanceBatch::Configure(int num_levels, double weight_exponent) {
+    m_num_levels = std::max(num_levels, 0);
+    m_weight_exponent = weight_exponent;
+    Clear();
+
+    // Same weights as ComputeWeightedImbalance: w_i = 1/(i+1)^w
+    m_weights.resize(m_num_levels);
+    for (int i = 0; i < m_num_levels; ++i) {
+        m_weights[i] =
+            1.0 / std::pow(static_cast<double>(i + 1), m_weight_exponent);
+    }
+
+    m_bid_sizes.assign(static_cast<size_t>(m_num_levels) * kCapacity, 0.0);
+    m_ask_sizes.assign(static_cast<size_t>(m_num_levels) * kCapacity, 0.0);
+}
+
+int ImbalanceBatch::Add(const int* bid_sizes, const int* ask_sizes,
+                        int levels) {
+    const int row = m_size++;
+    const int used = std::min(levels, m_num_levels);
+
+    for (int i = 0; i < used; ++i) {
+        m_bid_sizes[i * kCapacity + row] = static_cast<double>(bid_sizes[i]);
+        m_ask_sizes[i * kCapacity + row] = static_cast<double>(ask_sizes[i]);
+    }
+    for (int i = std::max(used, 0); i < m_num_levels; ++i) {
+        m_bid_sizes[i * kCapacity + row] = 0.0;
+        m_ask_sizes[i * kCapacity + row] = 0.0;
+    }
+    return row;
+}
+
+void ImbalanceBatch::SetState(int row, int persistence, bool in_position,
+                              bool has_working_buy) {
+    m_persistence[row] = persistence;
+    m_in_position[row] = in_position ? 1 : 0;
+    m_working_buy[row] = has_working_buy ? 1 : 0;
+}
+
+void ImbalanceBatch::ChainState(int row, int prev_row, bool in_position,
+                                bool has_working_buy) {
+    SetState(row, 0, in_position, has_working_buy);
+    m_prev_row[row] = prev_row;
+    m_chained.push_back(row);
+}
+
+void ImbalanceBatch::Evaluate(double entry_threshold, double exit_threshold,
+                              int persistence_len) {
+    if (m_size == 0) {
+        return;
+    }
+
+    // Round up to a full vector; kCapacity is a multiple of 8.
+    const int count = (m_size + 7) & ~7;
+    const Kernels& kernels = ActiveKernels();
+
+    kernels.imbalance(m_bid_sizes.empty() ? NULL : &m_bid_sizes[0],
+                      m_ask_sizes.empty() ? NULL : &m_ask_sizes[0],
+                      m_weights.empty() ? NULL : &m_weights[0], m_num_levels,
+                      count, &m_imbalance[0]);
+    kernels.transitions(&m_imbalance[0], &m_in_position[0],
+                        &m_working_buy[0], count, entry_threshold,
+                        exit_threshold, persistence_len, &m_persistence[0],
+                        &m_action[0]);
+
+    // The vector pass started chained rows from 0; redo them in row order
+    // from their predecessor's result, which is final by then.
+    for (size_t i = 0; i < m_chained.size(); ++i) {
+        const int row = m_chained[i];
+        m_persistence[row] = m_persistence[m_prev_row[row]];
+        TransitionsBody(&m_imbalance[row], &m_in_position[row],
+                        &m_working_buy[row], 1, entry_threshold,
+                        exit_threshold, persistence_len, &m_persistence[row],
+                        &m_action[row]);
+    }
+}
+
+const char* ImbalanceBatch::KernelName() {
+    return ActiveKernels().name;
+}
+
+bool ImbalanceBatch::UseKernel(const std::string& name) {
+    return KernelsByName(name, &ActiveKernels());
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#ifndef _STRATEGY_STUDIO_LIB_EXAMPLES_WOBI_IMBALANCE_BATCH_H_
+#define _STRATEGY_STUDIO_LIB_EXAMPLES_WOBI_IMBALANCE_BATCH_H_
+
+#include <string>
+#include <vector>
+
+/**
+ * ImbalanceBatch
+ *
+ * Structure-of-arrays batch of pending imbalance evaluations, one row per
+ * depth update, used to evaluate a burst of updates that share the same
+ * adapter_time in one pass instead of symbol by symbol.
+ *
+ * Book sizes are stored level-major (all instruments' level 0, then level 1,
+ * ...) so the kernels run across instruments: each SIMD lane is one symbol.
+ * Evaluate() computes every row's weighted imbalance and then applies the
+ * same threshold/persistence rules as EvaluateImbalanceSignal, leaving one
+ * Action per row for the caller to dispatch.
+ *
+ * A later update of an instrument that already has a row is chained to it
+ * (ChainState()): its streak starts from that row's result, so A,A,B,B
+ * bursts stay in one batch. Chained rows get their transition re-run in
+ * row order after the vector pass.
+ *
+ * Kernels: AVX-512 and AVX2 versions are picked once at runtime from the
+ * CPU's capabilities, with a portable scalar fallback. Imbalances are
+ * bit-identical to ComputeWeightedImbalance as long as the build keeps
+ * multiplies and adds separate (-ffp-contract=off in the Makefile).
+ */
+class ImbalanceBatch {
+   public:
+    enum Action { ACTION_NONE = 0, ACTION_BUY = 1, ACTION_SELL = 2 };
+
+    /** Rows per batch; the caller must flush once full() is true. */
+    static const int kCapacity = 256;
+
+   public:
+    ImbalanceBatch();
+
+    /** Set the number of levels (and their weights) rows will carry.
+     *  Clears the batch. */
+    void Configure(int num_levels, double weight_exponent);
+
+    /** Append a row. Sizes beyond levels are padded with zero, which
+     *  contributes nothing to either sum. Returns the row index. */
+    int Add(const int* bid_sizes, const int* ask_sizes, int levels);
+
+    /** Position state of a row, captured when its update arrived. */
+    void SetState(int row, int persistence, bool in_position,
+                  bool has_working_buy);
+
+    /** Like SetState(), for a row whose instrument already has prev_row in
+     *  this batch: it starts from prev_row's evaluated persistence. */
+    void ChainState(int row, int prev_row, bool in_position,
+                    bool has_working_buy);
+
+    /** Compute imbalances, persistence and actions for every row. */
+    void Evaluate(double entry_threshold, double exit_threshold,
+                  int persistence_len);
+
+    void Clear() {
+        m_size = 0;
+        m_chained.clear();
+    }
+
+    int size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool full() const { return m_size == kCapacity; }
+    int num_levels() const { return m_num_levels; }
+    double weight_exponent() const { return m_weight_exponent; }
+
+    double imbalance(int row) const { return m_imbalance[row]; }
+    int persistence(int row) const { return m_persistence[row]; }
+    Action action(int row) const {
+        return static_cast<Action>(m_action[row]);
+    }
+
+    /** Name of the kernel selected for this CPU ("avx512", "avx2" or
+     *  "scalar"). */
+    static const char* KernelName();
+
+    /** Force a kernel ("avx512", "avx2" or "scalar"). Returns false and
+     *  keeps the current one if this CPU cannot run it. */
+    static bool UseKernel(const std::string& name);
+
+   private:
+    int m_num_levels;
+    double m_weight_exponent;
+    int m_size;
+
+    std::vector<double> m_weights;    ///< w_i = 1 / (i+1)^w
+    std::vector<double> m_bid_sizes;  ///< [level * kCapacity + row]
+    std::vector<double> m_ask_sizes;  ///< [level * kCapacity + row]
+
+    std::vector<double> m_imbalance;  ///< [row]
+    std::vector<int> m_persistence;   ///< [row] in: before, out: after
+    std::vector<int> m_in_position;   ///< [row] 0/1
+    std::vector<int> m_working_buy;   ///< [row] 0/1
+    std::vector<int> m_action;        ///< [row] Action
+    std::vector<int> m_prev_row;      ///< [row] chained predecessor
+    std::vector<int> m_chained;       ///< chained rows, in row order
+};
+
+#endif
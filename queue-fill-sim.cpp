@@ -0,0 +1,319 @@
+#include "queue-fill-sim.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Prices are keyed in 1/10000ths, finer than any US equity tick.
+const double kPriceScale = 10000.0;
+
+}  // namespace
+
+/*===========================================================
+ *   Construction / Bookkeeping
+ *===========================================================*/
+
+QueueFillSimulator::QueueFillSimulator() : m_stamp(0) {}
+
+QueueFillSimulator::PriceKey QueueFillSimulator::PriceToKey(double price) {
+    return static_cast<PriceKey>(std::floor(price * kPriceScale + 0.5));
+}
+
+double QueueFillSimulator::KeyToPrice(PriceKey key) {
+    return static_cast<double>(key) / kPriceScale;
+}
+
+void QueueFillSimulator::Clear() {
+    m_bid_levels.clear();
+    m_ask_levels.clear();
+    m_index.clear();
+    m_nodes.clear();
+    m_free.clear();
+    m_stamp = 0;
+}
+
+int QueueFillSimulator::AllocNode() {
+    if (!m_free.empty()) {
+        int idx = m_free.back();
+        m_free.pop_back();
+        return idx;
+    }
+    m_nodes.push_back(Node());
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+void QueueFillSimulator::Unlink(Level* level, int idx) {
+    Node& node = m_nodes[idx];
+
+    if (node.prev != -1) {
+        m_nodes[node.prev].next = node.next;
+    } else {
+        level->head = node.next;
+    }
+    if (node.next != -1) {
+        m_nodes[node.next].prev = node.prev;
+    } else {
+        level->tail = node.prev;
+    }
+
+    level->resting -= node.size - node.filled;
+    m_index.erase(node.order_id);
+    m_free.push_back(idx);
+}
+
+void QueueFillSimulator::SyncStamp(Level* level) const {
+    // Anything left unmatched from an earlier timestamp is final: trades
+    // with no decrease and decreases with no trade (cancels) both stand.
+    if (level->stamp != m_stamp) {
+        level->stamp = m_stamp;
+        level->pending_trade = 0;
+        level->pending_decrease = 0;
+        level->applied_cancel = 0;
+    }
+}
+
+void QueueFillSimulator::EraseIfEmpty(LevelMap* levels,
+                                      LevelMap::iterator it) {
+    if (it->second.head == -1) {
+        levels->erase(it);
+    }
+}
+
+/*===========================================================
+ *   Order Tracking
+ *===========================================================*/
+
+bool QueueFillSimulator::AddOrder(OrderKey order_id, bool is_buy,
+                                  double price, int size, int visible_size) {
+    if (size <= 0 || IsTracked(order_id)) {
+        return false;
+    }
+
+    const PriceKey key = PriceToKey(price);
+    LevelMap& levels = is_buy ? m_bid_levels : m_ask_levels;
+
+    LevelMap::iterator it = levels.find(key);
+    if (it == levels.end()) {
+        Level fresh;
+        fresh.advanced = 0;
+        fresh.last_size = 0;
+        fresh.stamp = m_stamp;
+        fresh.pending_trade = 0;
+        fresh.pending_decrease = 0;
+        fresh.applied_cancel = 0;
+        fresh.resting = 0;
+        fresh.head = -1;
+        fresh.tail = -1;
+        it = levels.insert(std::make_pair(key, fresh)).first;
+    }
+    Level& level = it->second;
+    level.last_size = std::max(visible_size, 0);
+
+    const int idx = AllocNode();
+    Node& node = m_nodes[idx];
+    node.order_id = order_id;
+    node.price = key;
+    node.is_buy = is_buy;
+    node.size = size;
+    node.filled = 0;
+    // The historical book never contains our orders, so anything of ours
+    // already resting here is added on top of the visible size.
+    node.start = level.advanced + level.last_size + level.resting;
+    node.prev = level.tail;
+    node.next = -1;
+
+    if (level.tail != -1) {
+        m_nodes[level.tail].next = idx;
+    } else {
+        level.head = idx;
+    }
+    level.tail = idx;
+    level.resting += size;
+
+    m_index[order_id] = idx;
+    return true;
+}
+
+bool QueueFillSimulator::RemoveOrder(OrderKey order_id) {
+    OrderIndex::iterator found = m_index.find(order_id);
+    if (found == m_index.end()) {
+        return false;
+    }
+
+    const Node& node = m_nodes[found->second];
+    LevelMap& levels = node.is_buy ? m_bid_levels : m_ask_levels;
+    LevelMap::iterator it = levels.find(node.price);
+
+    // Orders queued behind this one keep their position: we do not know
+    // whether the exchange would have let them step up, so stay conservative.
+    Unlink(&it->second, found->second);
+    EraseIfEmpty(&levels, it);
+    return true;
+}
+
+long long QueueFillSimulator::SizeAhead(OrderKey order_id) const {
+    OrderIndex::const_iterator found = m_index.find(order_id);
+    if (found == m_index.end()) {
+        return -1;
+    }
+
+    const Node& node = m_nodes[found->second];
+    const LevelMap& levels = node.is_buy ? m_bid_levels : m_ask_levels;
+    const Level& level = levels.find(node.price)->second;
+    return std::max(node.start - level.advanced, 0LL);
+}
+
+/*===========================================================
+ *   Market Data
+ *===========================================================*/
+
+void QueueFillSimulator::Advance(Level* level, PriceKey key, long long volume,
+                                 FillList* fills) {
+    level->advanced += volume;
+
+    // Only the head can be partially filled; stop at the first order the
+    // queue has not reached yet.
+    while (level->head != -1) {
+        Node& node = m_nodes[level->head];
+        const long long reached =
+            std::min<long long>(level->advanced - node.start, node.size);
+        if (reached <= node.filled) {
+            break;
+        }
+
+        const int delta = static_cast<int>(reached) - node.filled;
+        node.filled += delta;
+        level->resting -= delta;
+
+        if (fills) {
+            Fill fill;
+            fill.order_id = node.order_id;
+            fill.is_buy = node.is_buy;
+            fill.price = KeyToPrice(key);
+            fill.size = delta;
+            fill.leaves = node.size - node.filled;
+            fills->push_back(fill);
+        }
+
+        if (node.filled < node.size) {
+            break;
+        }
+        // Unlink() subtracts the unfilled remainder, which is now zero.
+        Unlink(level, level->head);
+    }
+}
+
+void QueueFillSimulator::OnLevelSize(bool is_bid, double price, int size) {
+    LevelMap& levels = is_bid ? m_bid_levels : m_ask_levels;
+    LevelMap::iterator it = levels.find(PriceToKey(price));
+    if (it == levels.end()) {
+        return;
+    }
+
+    Level& level = it->second;
+    const int decrease = level.last_size - std::max(size, 0);
+    level.last_size = std::max(size, 0);
+    if (decrease <= 0) {
+        return;
+    }
+    SyncStamp(&level);
+
+    // Decreases already accounted for by a trade print are not cancels.
+    const int explained = std::min(decrease, level.pending_trade);
+    level.pending_trade -= explained;
+    const int cancelled = decrease - explained;
+    if (cancelled <= 0) {
+        return;
+    }
+
+    // Apply the rest as a cancel for now, but remember it: a trade printed
+    // later in the same timestamp may turn out to be the cause.
+    level.pending_decrease += cancelled;
+    if (level.head == -1) {
+        return;
+    }
+    const long long ahead = m_nodes[level.head].start - level.advanced;
+    if (ahead > 0) {
+        const int applied =
+            static_cast<int>(std::min<long long>(cancelled, ahead));
+        level.advanced += applied;
+        level.applied_cancel += applied;
+    }
+}
+
+void QueueFillSimulator::OnTrade(double price, int size, FillList* fills) {
+    if (size <= 0) {
+        return;
+    }
+
+    const PriceKey key = PriceToKey(price);
+    LevelMap* sides[2] = {&m_bid_levels, &m_ask_levels};
+    for (int s = 0; s < 2; ++s) {
+        LevelMap::iterator it = sides[s]->find(key);
+        if (it == sides[s]->end()) {
+            continue;
+        }
+        Level& level = it->second;
+        SyncStamp(&level);
+
+        // Part of this trade may already have been seen as a decrease and
+        // applied as a cancel; only advance the queue by what is left.
+        const int matched = std::min(size, level.pending_decrease);
+        const int already = std::min(matched, level.applied_cancel);
+        level.pending_decrease -= matched;
+        level.applied_cancel -= already;
+        level.pending_trade += size - matched;
+
+        Advance(&level, key, size - already, fills);
+        EraseIfEmpty(sides[s], it);
+    }
+}
+
+void QueueFillSimulator::FillAll(LevelMap* levels, LevelMap::iterator it,
+                                 FillList* fills) {
+    Level& level = it->second;
+    while (level.head != -1) {
+        Node& node = m_nodes[level.head];
+        const int delta = node.size - node.filled;
+
+        if (fills) {
+            Fill fill;
+            fill.order_id = node.order_id;
+            fill.is_buy = node.is_buy;
+            fill.price = KeyToPrice(it->first);
+            fill.size = delta;
+            fill.leaves = 0;
+            fills->push_back(fill);
+        }
+        Unlink(&level, level.head);
+    }
+    levels->erase(it);
+}
+
+void QueueFillSimulator::OnBestPrices(double best_bid, double best_ask,
+                                      FillList* fills) {
+    // Resting buys are crossed once the ask trades down to their price and
+    // resting sells once the bid trades up to theirs. We only ever rest at a
+    // handful of levels, so a linear scan is cheaper than an ordered map.
+    if (best_ask > 0.0 && !m_bid_levels.empty()) {
+        const PriceKey ask_key = PriceToKey(best_ask);
+        for (LevelMap::iterator it = m_bid_levels.begin();
+             it != m_bid_levels.end();) {
+            LevelMap::iterator cur = it++;
+            if (cur->first >= ask_key) {
+                FillAll(&m_bid_levels, cur, fills);
+            }
+        }
+    }
+
+    if (best_bid > 0.0 && !m_ask_levels.empty()) {
+        const PriceKey bid_key = PriceToKey(best_bid);
+        for (LevelMap::iterator it = m_ask_levels.begin();
+             it != m_ask_levels.end();) {
+            LevelMap::iterator cur = it++;
+            if (cur->first <= bid_key) {
+                FillAll(&m_ask_levels, cur, fills);
+            }
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#ifndef _STRATEGY_STUDIO_LIB_EXAMPLES_WOBI_QUEUE_FILL_SIM_H_
+#define _STRATEGY_STUDIO_LIB_EXAMPLES_WOBI_QUEUE_FILL_SIM_H_
+
+#include <boost/unordered_map.hpp>
+#include <vector>
+
+/**
+ * QueueFillSimulator
+ *
+ * Queue-position-aware fill model for passive (resting limit) orders of a
+ * single instrument. It is fed from the depth and trade events the strategy
+ * already receives and reports when our resting orders would have filled.
+ *
+ * Each price level we rest at keeps an intrusive FIFO of our orders plus a
+ * monotonically increasing "advanced" counter: the total volume that has left
+ * the queue at that level since we started tracking it. An order remembers
+ * its absolute start position in that coordinate when it joins, so the size
+ * ahead of it is simply (start - advanced) and every update is O(1) per
+ * level, independent of how many of our orders rest there.
+ *
+ * Queue model:
+ *   - Joining:  ahead = visible level size + our own resting size there.
+ *   - Trades:   volume at our price advances the queue and, once the size
+ *               ahead is gone, fills our orders front to back.
+ *   - Cancels:  level size decreases not explained by a trade are treated
+ *               as cancels ahead of our earliest order (capped so a cancel
+ *               can never fill us).
+ *   - Matching: trades and decreases are matched within one timestamp (see
+ *               BeginTimestamp()), in either arrival order. A decrease seen
+ *               first is applied as a cancel; when the trade for it prints,
+ *               only the part of the trade not already applied advances the
+ *               queue. Unmatched volume is dropped at the next timestamp.
+ *   - Adds:     level size increases join behind us and are ignored.
+ *   - Crossing: if the opposite best price trades through our price, every
+ *               order at that level is filled in full.
+ *
+ * The model only reports fills; it does not place or fill orders itself.
+ */
+class QueueFillSimulator {
+   public:
+    typedef long long PriceKey;
+    typedef long long OrderKey;
+
+    struct Fill {
+        OrderKey order_id;
+        bool is_buy;
+        double price;
+        int size;    ///< size filled by this event
+        int leaves;  ///< size still resting after this event
+    };
+    typedef std::vector<Fill> FillList;
+
+   public:
+    QueueFillSimulator();
+
+    /** Mark the start of a new event timestamp. Trades and level decreases
+     *  are only matched against each other within one timestamp. */
+    void BeginTimestamp() { ++m_stamp; }
+
+    /** Start tracking a resting order. visible_size is the book size at
+     *  price when the order joined. Returns false on duplicate id. */
+    bool AddOrder(OrderKey order_id, bool is_buy, double price, int size,
+                  int visible_size);
+
+    /** Stop tracking an order (cancelled or completed by the exchange). */
+    bool RemoveOrder(OrderKey order_id);
+
+    /** Latest visible size at a price level (size 0 = level removed). */
+    void OnLevelSize(bool is_bid, double price, int size);
+
+    /** Trade print at price; appends any resulting fills to fills. */
+    void OnTrade(double price, int size, FillList* fills);
+
+    /** Latest best bid / ask; fills our orders that the market crossed. */
+    void OnBestPrices(double best_bid, double best_ask, FillList* fills);
+
+    bool HasRestingOrders() const { return !m_index.empty(); }
+    bool HasRestingOrders(bool is_buy) const {
+        return is_buy ? !m_bid_levels.empty() : !m_ask_levels.empty();
+    }
+    bool IsTracked(OrderKey order_id) const {
+        return m_index.find(order_id) != m_index.end();
+    }
+
+    /** Size currently ahead of an order in its queue (-1 if unknown). */
+    long long SizeAhead(OrderKey order_id) const;
+
+    /** Visit every level price we rest at on one side. */
+    template <typename Visitor>
+    void ForEachLevelPrice(bool is_buy, Visitor visit) const {
+        const LevelMap& levels = is_buy ? m_bid_levels : m_ask_levels;
+        for (LevelMap::const_iterator it = levels.begin(); it != levels.end();
+             ++it) {
+            visit(KeyToPrice(it->first));
+        }
+    }
+
+    void Clear();
+
+    static PriceKey PriceToKey(double price);
+    static double KeyToPrice(PriceKey key);
+
+   private:
+    struct Node {
+        OrderKey order_id;
+        PriceKey price;
+        bool is_buy;
+        int size;
+        int filled;
+        long long start;  ///< queue position in the level's advanced units
+        int prev;
+        int next;
+    };
+
+    struct Level {
+        long long advanced;    ///< volume that has left the queue so far
+        int last_size;         ///< last visible size seen for the level
+        long long stamp;       ///< timestamp of the pending_* counters
+        int pending_trade;     ///< traded size not yet seen as a decrease
+        int pending_decrease;  ///< decrease not yet matched to a trade
+        int applied_cancel;    ///< part of pending_decrease already advanced
+        int resting;           ///< our unfilled size resting at the level
+        int head;
+        int tail;
+    };
+
+    typedef boost::unordered_map<PriceKey, Level> LevelMap;
+    typedef boost::unordered_map<OrderKey, int> OrderIndex;
+
+    int AllocNode();
+    void Unlink(Level* level, int idx);
+    void SyncStamp(Level* level) const;
+    void Advance(Level* level, PriceKey key, long long volume,
+                 FillList* fills);
+    void FillAll(LevelMap* levels, LevelMap::iterator it, FillList* fills);
+    void EraseIfEmpty(LevelMap* levels, LevelMap::iterator it);
+
+    LevelMap m_bid_levels;  ///< levels of our resting buys
+    LevelMap m_ask_levels;  ///< levels of our resting sells
+    OrderIndex m_index;     ///< order id -> node slot
+
+    std::vector<Node> m_nodes;  ///< node pool; slots are recycled
+    std::vector<int> m_free;    ///< free slots in m_nodes
+
+    long long m_stamp;  ///< current timestamp, see BeginTimestamp()
+};
+
+#endif
@@ -0,0 +1,306 @@
+// Standalone microbenchmark for ImbalanceBatch (no Strategy Studio needed).
+// Compares per-update evaluation (ComputeWeightedImbalance followed by
+// EvaluateImbalanceSignal, with the strategy's per-instrument maps) with the
+// batched path (EnqueueImbalance's Add + SetState/ChainState, then
+// FlushImbalanceBatch's Evaluate and write-back). Each burst updates every
+// symbol of the universe at one adapter_time. Book, portfolio and order
+// tracker calls cost the same on both paths and are left out.
+// Run with: make bench
+
+#include "../imbalance-batch.h"
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const int kLevels = 5;
+const double kWeightExponent = 1.0;
+const double kEntry = 0.1;
+const double kExit = -0.1;
+const int kPersistenceLen = 3;
+const long long kUpdatesPerRun = 4000000;
+const int kRepeats = 3;  ///< best of, against noise from other processes
+
+typedef const int* InstrumentKey;
+typedef boost::unordered_map<InstrumentKey, int> PersistenceMap;
+typedef boost::unordered_map<InstrumentKey, double> ImbalanceMap;
+
+unsigned int g_seed = 12345u;
+int Rand(int n) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return static_cast<int>((g_seed >> 8) % static_cast<unsigned int>(n));
+}
+
+// Level sizes for one depth update
+struct Book {
+    int bids[kLevels];
+    int asks[kLevels];
+};
+
+struct Universe {
+    std::vector<int> symbols;  ///< addresses stand in for Instrument*
+    std::vector<char> in_position;
+    std::vector<char> working_buy;
+    std::vector<Book> books;  ///< pool the updates cycle through
+};
+
+// ComputeWeightedImbalance + EvaluateImbalanceSignal, as in wobi-signal.cpp
+struct PerUpdate {
+    PersistenceMap persistence_map;
+    ImbalanceMap last_imbalance;
+    long long actions;
+
+    PerUpdate() : actions(0) {}
+
+    void Update(InstrumentKey inst, const Book& book, bool in_position,
+                bool has_working_buy) {
+        double weighted_bids = 0.0;
+        double weighted_asks = 0.0;
+        double weighted_total = 0.0;
+        for (int i = 0; i < kLevels; ++i) {
+            const double w =
+                1.0 / std::pow(static_cast<double>(i + 1), kWeightExponent);
+            weighted_bids += w * static_cast<double>(book.bids[i]);
+            weighted_asks += w * static_cast<double>(book.asks[i]);
+            weighted_total +=
+                w * static_cast<double>(book.bids[i] + book.asks[i]);
+        }
+        const double imbalance =
+            weighted_total == 0.0
+                ? 0.0
+                : (weighted_bids - weighted_asks) / weighted_total;
+
+        last_imbalance[inst] = imbalance;
+        if (persistence_map.find(inst) == persistence_map.end()) {
+            persistence_map[inst] = 0;
+        }
+
+        if (!in_position) {
+            if (imbalance > kEntry) {
+                persistence_map[inst] += 1;
+                if (persistence_map[inst] >= kPersistenceLen) {
+                    actions += !has_working_buy;
+                    persistence_map[inst] = 0;
+                }
+            } else {
+                persistence_map[inst] = 0;
+            }
+        } else {
+            if (imbalance > kEntry) {
+                persistence_map[inst] += 1;
+                if (persistence_map[inst] >= kPersistenceLen) {
+                    persistence_map[inst] = 0;
+                }
+            } else {
+                persistence_map[inst] = 0;
+            }
+            if (imbalance < kExit) {
+                ++actions;
+                persistence_map[inst] = 0;
+            }
+        }
+    }
+
+    void EndBurst() {}
+    double AvgRows() const { return 1.0; }
+};
+
+// EnqueueImbalance / FlushImbalanceBatch, as in wobi-signal.cpp
+struct Batched {
+    struct Entry {
+        int* persistence;
+        double* last_imbalance;
+        bool in_position;
+        bool has_working_buy;
+    };
+    struct Slot {
+        int* persistence;
+        double* last_imbalance;
+        long long batch_id;
+        int row;
+    };
+    typedef boost::unordered_map<InstrumentKey, Slot> SlotMap;
+
+    ImbalanceBatch batch;
+    SlotMap slots;
+    std::vector<Entry> entries;
+    PersistenceMap persistence_map;
+    ImbalanceMap last_imbalance;
+    long long actions;
+    long long flushes;
+    long long rows_flushed;
+
+    Batched() : actions(0), flushes(0), rows_flushed(0) {
+        batch.Configure(kLevels, kWeightExponent);
+    }
+
+    void Update(InstrumentKey inst, const Book& book, bool in_position,
+                bool has_working_buy) {
+        if (batch.full()) {
+            Flush();
+        }
+        const int row = batch.Add(book.bids, book.asks, kLevels);
+
+        SlotMap::iterator it = slots.find(inst);
+        if (it == slots.end()) {
+            const Slot slot = {&persistence_map[inst], &last_imbalance[inst],
+                               -1, 0};
+            it = slots.insert(std::make_pair(inst, slot)).first;
+        }
+        Slot& slot = it->second;
+        if (slot.batch_id != flushes) {
+            const Entry entry = {slot.persistence, slot.last_imbalance,
+                                 in_position, has_working_buy};
+            batch.SetState(row, *entry.persistence, entry.in_position,
+                           entry.has_working_buy);
+            entries.push_back(entry);
+        } else {
+            const Entry entry = entries[slot.row];
+            batch.ChainState(row, slot.row, entry.in_position,
+                             entry.has_working_buy);
+            entries.push_back(entry);
+        }
+        slot.batch_id = flushes;
+        slot.row = row;
+    }
+
+    void Flush() {
+        if (batch.empty()) {
+            return;
+        }
+        const int size = batch.size();
+        batch.Evaluate(kEntry, kExit, kPersistenceLen);
+        ++flushes;
+        rows_flushed += size;
+        for (int row = 0; row < size; ++row) {
+            *entries[row].last_imbalance = batch.imbalance(row);
+            *entries[row].persistence = batch.persistence(row);
+            actions += batch.action(row) != ImbalanceBatch::ACTION_NONE;
+        }
+        batch.Clear();
+        entries.clear();
+    }
+
+    // The next burst has a new adapter_time
+    void EndBurst() { Flush(); }
+    double AvgRows() const {
+        return static_cast<double>(rows_flushed) / static_cast<double>(flushes);
+    }
+};
+
+Universe MakeUniverse(int symbols) {
+    g_seed = 12345u;
+    Universe u;
+    u.symbols.resize(symbols);
+    u.in_position.resize(symbols);
+    u.working_buy.resize(symbols);
+    for (int s = 0; s < symbols; ++s) {
+        u.in_position[s] = Rand(3) == 0;
+        u.working_buy[s] = Rand(5) == 0;
+    }
+    u.books.resize(1 << 16);
+    for (size_t k = 0; k < u.books.size(); ++k) {
+        // Skew one side per update so the thresholds are crossed both ways
+        const int skew = Rand(3);
+        for (int i = 0; i < kLevels; ++i) {
+            u.books[k].bids[i] = 100 + Rand(500) + (skew == 0 ? 400 : 0);
+            u.books[k].asks[i] = 100 + Rand(500) + (skew == 1 ? 400 : 0);
+        }
+    }
+    return u;
+}
+
+struct Result {
+    double ns_per_update;  ///< best of kRepeats
+    long long actions;
+    double avg_rows;
+};
+
+// Runs bursts of `symbols` x `per_symbol` updates (A,A,B,B order) through
+// a fresh Path, kRepeats times.
+template <typename Path>
+Result Run(const Universe& u, int per_symbol) {
+    const int symbols = static_cast<int>(u.symbols.size());
+    const long long bursts =
+        std::max(1LL, kUpdatesPerRun / (symbols * per_symbol));
+    const size_t mask = u.books.size() - 1;
+    Result result = {0.0, 0, 0.0};
+
+    for (int repeat = 0; repeat < kRepeats; ++repeat) {
+        Path path;
+        size_t next_book = 0;
+
+        const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (long long b = 0; b < bursts; ++b) {
+            for (int s = 0; s < symbols; ++s) {
+                for (int r = 0; r < per_symbol; ++r) {
+                    path.Update(&u.symbols[s], u.books[next_book++ & mask],
+                                u.in_position[s] != 0,
+                                u.working_buy[s] != 0);
+                }
+            }
+            path.EndBurst();
+        }
+        const std::chrono::steady_clock::time_point end =
+            std::chrono::steady_clock::now();
+
+        const double ns =
+            std::chrono::duration<double, std::nano>(end - start).count() /
+            static_cast<double>(bursts * symbols * per_symbol);
+        if (repeat == 0 || ns < result.ns_per_update) {
+            result.ns_per_update = ns;
+        }
+        result.actions = path.actions;
+        result.avg_rows = path.AvgRows();
+    }
+    return result;
+}
+
+}  // namespace
+
+int main() {
+    const int universes[] = {8, 64, 256, 1024};
+    const char* kernels[] = {"scalar", "avx2", "avx512"};
+    int failures = 0;
+
+    std::printf("imbalance-batch-bench: ns per depth update, %d levels\n",
+                kLevels);
+    std::printf("%8s %8s %10s %10s %10s %10s %9s\n", "symbols", "per_sym",
+                "per-update", "scalar", "avx2", "avx512", "avg_rows");
+
+    for (int u = 0; u < 4; ++u) {
+        const Universe universe = MakeUniverse(universes[u]);
+        for (int per_symbol = 1; per_symbol <= 2; ++per_symbol) {
+            const Result per_update = Run<PerUpdate>(universe, per_symbol);
+            std::printf("%8d %8d %10.1f", universes[u], per_symbol,
+                        per_update.ns_per_update);
+
+            double avg_rows = 0.0;
+            for (int k = 0; k < 3; ++k) {
+                if (!ImbalanceBatch::UseKernel(kernels[k])) {
+                    std::printf(" %10s", "n/a");
+                    continue;
+                }
+                const Result batched = Run<Batched>(universe, per_symbol);
+                std::printf(" %10.1f", batched.ns_per_update);
+                avg_rows = batched.avg_rows;
+
+                // Same decisions as the per-update path, or the timing is moot
+                if (batched.actions != per_update.actions) {
+                    std::printf("\n%s: %lld actions, per-update %lld\n",
+                                kernels[k], batched.actions,
+                                per_update.actions);
+                    ++failures;
+                }
+            }
+            std::printf(" %9.1f\n", avg_rows);
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+// Standalone checks for ImbalanceBatch (no Strategy Studio needed).
+// Every kernel this CPU can run is compared against a scalar port of
+// ComputeWeightedImbalance and EvaluateImbalanceSignal, imbalances exactly.
+// Run with: make check
+
+#include "../imbalance-batch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+// Small deterministic generator so results do not depend on the libc rand()
+unsigned int g_seed = 12345u;
+int Rand(int n) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return static_cast<int>((g_seed >> 8) % static_cast<unsigned int>(n));
+}
+
+// ComputeWeightedImbalance on plain level sizes
+double ReferenceImbalance(const int* bids, const int* asks, int levels,
+                          int num_levels, double weight_exponent) {
+    const int used = std::min(levels, num_levels);
+    double weighted_bids = 0.0;
+    double weighted_asks = 0.0;
+    double weighted_total = 0.0;
+    for (int i = 0; i < used; ++i) {
+        const double w =
+            1.0 / std::pow(static_cast<double>(i + 1), weight_exponent);
+        weighted_bids += w * static_cast<double>(bids[i]);
+        weighted_asks += w * static_cast<double>(asks[i]);
+        weighted_total += w * static_cast<double>(bids[i] + asks[i]);
+    }
+    if (weighted_total == 0.0) {
+        return 0.0;
+    }
+    return (weighted_bids - weighted_asks) / weighted_total;
+}
+
+// EvaluateImbalanceSignal's branches, returning the action taken
+int ReferenceTransition(double imbalance, bool in_position,
+                        bool has_working_buy, double entry, double exit,
+                        int len, int* persistence) {
+    int action = ImbalanceBatch::ACTION_NONE;
+    if (!in_position && !has_working_buy) {
+        if (imbalance > entry) {
+            *persistence += 1;
+            if (*persistence >= len) {
+                action = ImbalanceBatch::ACTION_BUY;
+                *persistence = 0;
+            }
+        } else {
+            *persistence = 0;
+        }
+    } else if (!in_position && has_working_buy) {
+        if (imbalance > entry) {
+            *persistence += 1;
+            if (*persistence >= len) {
+                *persistence = 0;
+            }
+        } else {
+            *persistence = 0;
+        }
+    } else {
+        if (imbalance > entry) {
+            *persistence += 1;
+            if (*persistence >= len) {
+                *persistence = 0;
+            }
+        } else {
+            *persistence = 0;
+        }
+        if (imbalance < exit) {
+            action = ImbalanceBatch::ACTION_SELL;
+            *persistence = 0;
+        }
+    }
+    return action;
+}
+
+void RandomBatches(const char* kernel) {
+    g_seed = 12345u;
+    int mismatches = 0;
+
+    for (int trial = 0; trial < 2000; ++trial) {
+        const int num_levels = 1 + Rand(8);
+        const double weight_exponent = 0.5 + Rand(20) / 10.0;
+        const double entry = (Rand(100) - 50) / 100.0;
+        const double exit = (Rand(100) - 50) / 100.0;
+        const int len = Rand(5);
+        const int rows = 1 + Rand(ImbalanceBatch::kCapacity);
+        // Fewer instruments than rows, so some rows chain to earlier ones
+        const int instruments = 1 + Rand(rows);
+
+        ImbalanceBatch batch;
+        batch.Configure(num_levels, weight_exponent);
+
+        std::vector<double> expected_imbalance(rows);
+        std::vector<int> expected_persistence(rows);
+        std::vector<int> expected_action(rows);
+        std::vector<int> last_row(instruments, -1);
+        std::vector<int> streak(instruments, 0);
+
+        for (int row = 0; row < rows; ++row) {
+            // Levels beyond num_levels and empty books both get exercised
+            const int levels = Rand(num_levels + 2);
+            int bids[10];
+            int asks[10];
+            for (int i = 0; i < 10; ++i) {
+                bids[i] = Rand(3) ? Rand(1000) : 0;
+                asks[i] = Rand(3) ? Rand(1000) : 0;
+            }
+            batch.Add(bids, asks, levels);
+
+            const int inst = Rand(instruments);
+            const bool in_position = Rand(2) != 0;
+            const bool has_working_buy = Rand(2) != 0;
+            int persistence = streak[inst];
+            if (last_row[inst] < 0) {
+                persistence = Rand(6);
+                batch.SetState(row, persistence, in_position,
+                               has_working_buy);
+            } else {
+                batch.ChainState(row, last_row[inst], in_position,
+                                 has_working_buy);
+            }
+            last_row[inst] = row;
+
+            const double imbalance = ReferenceImbalance(
+                bids, asks, levels, num_levels, weight_exponent);
+            expected_imbalance[row] = imbalance;
+            expected_action[row] =
+                ReferenceTransition(imbalance, in_position, has_working_buy,
+                                    entry, exit, len, &persistence);
+            expected_persistence[row] = persistence;
+            streak[inst] = persistence;
+        }
+
+        batch.Evaluate(entry, exit, len);
+
+        for (int row = 0; row < rows; ++row) {
+            if (batch.imbalance(row) != expected_imbalance[row] ||
+                batch.persistence(row) != expected_persistence[row] ||
+                batch.action(row) != expected_action[row]) {
+                if (mismatches++ < 5) {
+                    std::printf(
+                        "%s: trial %d row %d: I=%.17g/%.17g p=%d/%d "
+                        "action=%d/%d\n",
+                        kernel, trial, row, batch.imbalance(row),
+                        expected_imbalance[row], batch.persistence(row),
+                        expected_persistence[row], batch.action(row),
+                        expected_action[row]);
+                }
+            }
+        }
+    }
+
+    if (mismatches) {
+        std::printf("%s: %d mismatching rows\n", kernel, mismatches);
+        ++g_failures;
+    }
+}
+
+void NegativeLevelsAreEmpty() {
+    ImbalanceBatch batch;
+    batch.Configure(-3, 1.0);
+    batch.Add(NULL, NULL, 0);
+    batch.SetState(0, 0, false, false);
+    batch.Evaluate(0.0, 0.0, 1);
+    if (batch.num_levels() != 0 || batch.imbalance(0) != 0.0 ||
+        batch.action(0) != ImbalanceBatch::ACTION_NONE) {
+        std::printf("negative num_levels: expected an empty, neutral row\n");
+        ++g_failures;
+    }
+}
+
+}  // namespace
+
+int main() {
+    const char* kernels[] = {"scalar", "avx2", "avx512"};
+    for (int k = 0; k < 3; ++k) {
+        if (!ImbalanceBatch::UseKernel(kernels[k])) {
+            std::printf("imbalance-batch-check: %s not supported, skipped\n",
+                        kernels[k]);
+            continue;
+        }
+        RandomBatches(kernels[k]);
+        NegativeLevelsAreEmpty();
+        std::printf("imbalance-batch-check: %s checked\n",
+                    ImbalanceBatch::KernelName());
+    }
+
+    std::printf("imbalance-batch-check: %s\n", g_failures ? "FAILED" : "OK");
+    return g_failures ? 1 : 0;
+}
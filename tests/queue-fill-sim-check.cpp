@@ -0,0 +1,192 @@
+// Standalone checks for QueueFillSimulator (no Strategy Studio needed).
+// Run with: make check
+
+#include "../queue-fill-sim.h"
+#include <cstdio>
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK_EQ(actual, expected)                                        \
+    do {                                                                  \
+        const long long a_ = (actual);                                    \
+        const long long e_ = (expected);                                  \
+        if (a_ != e_) {                                                   \
+            std::printf("%s:%d: %s == %lld, expected %lld\n", __FILE__,   \
+                        __LINE__, #actual, a_, e_);                       \
+            ++g_failures;                                                 \
+        }                                                                 \
+    } while (0)
+
+long long FilledSize(const QueueFillSimulator::FillList& fills,
+                     QueueFillSimulator::OrderKey id) {
+    long long total = 0;
+    for (size_t i = 0; i < fills.size(); ++i) {
+        if (fills[i].order_id == id) {
+            total += fills[i].size;
+        }
+    }
+    return total;
+}
+
+void TradeFillsFrontToBack() {
+    QueueFillSimulator sim;
+    QueueFillSimulator::FillList fills;
+
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 100, 500);
+    sim.AddOrder(2, true, 100.00, 50, 500);
+    CHECK_EQ(sim.SizeAhead(1), 500);
+    CHECK_EQ(sim.SizeAhead(2), 600);  // our first order sits ahead of it
+
+    sim.OnTrade(100.00, 550, &fills);
+    CHECK_EQ(FilledSize(fills, 1), 50);
+    CHECK_EQ(FilledSize(fills, 2), 0);
+    CHECK_EQ(sim.SizeAhead(2), 50);
+
+    fills.clear();
+    sim.BeginTimestamp();
+    sim.OnTrade(100.00, 200, &fills);
+    CHECK_EQ(FilledSize(fills, 1), 50);
+    CHECK_EQ(FilledSize(fills, 2), 50);
+    CHECK_EQ(sim.HasRestingOrders(), 0);
+}
+
+void CancelAdvancesButNeverFills() {
+    QueueFillSimulator sim;
+
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 100, 500);
+    sim.OnLevelSize(true, 100.00, 300);
+    CHECK_EQ(sim.SizeAhead(1), 300);
+
+    // Everything ahead cancels and more: we reach the front, no fill
+    sim.BeginTimestamp();
+    sim.OnLevelSize(true, 100.00, 0);
+    CHECK_EQ(sim.SizeAhead(1), 0);
+    CHECK_EQ(sim.IsTracked(1), 1);
+
+    // Size increases join behind us
+    sim.BeginTimestamp();
+    sim.OnLevelSize(true, 100.00, 800);
+    CHECK_EQ(sim.SizeAhead(1), 0);
+}
+
+void TradeBeforeDecreaseCountsOnce() {
+    QueueFillSimulator sim;
+    QueueFillSimulator::FillList fills;
+
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 100, 500);
+
+    sim.BeginTimestamp();
+    sim.OnTrade(100.00, 200, &fills);
+    sim.OnLevelSize(true, 100.00, 300);
+    CHECK_EQ(sim.SizeAhead(1), 300);
+    CHECK_EQ(fills.size(), 0);
+}
+
+void DecreaseBeforeTradeCountsOnce() {
+    QueueFillSimulator sim;
+    QueueFillSimulator::FillList fills;
+
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 100, 500);
+
+    sim.BeginTimestamp();
+    sim.OnLevelSize(true, 100.00, 300);
+    sim.OnTrade(100.00, 200, &fills);
+    CHECK_EQ(sim.SizeAhead(1), 300);
+    CHECK_EQ(fills.size(), 0);
+}
+
+void DecreaseBeforeTradeStillFills() {
+    QueueFillSimulator sim;
+    QueueFillSimulator::FillList fills;
+
+    // 100 ahead; a 300-lot trade shows up as a decrease first. The cancel
+    // part is capped at the front of the queue, the trade then fills us.
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 500, 100);
+
+    sim.BeginTimestamp();
+    sim.OnLevelSize(true, 100.00, 0);
+    CHECK_EQ(fills.size(), 0);
+    sim.OnTrade(100.00, 300, &fills);
+    CHECK_EQ(FilledSize(fills, 1), 200);
+}
+
+void UnmatchedTradeDoesNotHideLaterCancels() {
+    QueueFillSimulator sim;
+    QueueFillSimulator::FillList fills;
+
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 100, 500);
+
+    // A print with no matching depth decrease in its timestamp
+    sim.BeginTimestamp();
+    sim.OnTrade(100.00, 100, &fills);
+    CHECK_EQ(sim.SizeAhead(1), 400);
+
+    // A later decrease is a real cancel, not the old trade
+    sim.BeginTimestamp();
+    sim.OnLevelSize(true, 100.00, 400);
+    CHECK_EQ(sim.SizeAhead(1), 300);
+}
+
+void CrossingFillsEverything() {
+    QueueFillSimulator sim;
+    QueueFillSimulator::FillList fills;
+
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 100, 500);
+    sim.AddOrder(2, true, 99.99, 100, 500);
+    sim.AddOrder(3, false, 100.05, 100, 500);
+
+    sim.OnBestPrices(99.98, 100.01, &fills);
+    CHECK_EQ(fills.size(), 0);
+
+    sim.OnBestPrices(99.98, 100.00, &fills);
+    CHECK_EQ(FilledSize(fills, 1), 100);
+    CHECK_EQ(FilledSize(fills, 2), 0);
+    CHECK_EQ(sim.IsTracked(1), 0);
+
+    fills.clear();
+    sim.OnBestPrices(100.05, 100.06, &fills);
+    CHECK_EQ(FilledSize(fills, 3), 100);
+    CHECK_EQ(sim.IsTracked(2), 1);
+}
+
+void RemoveOrderUnlinks() {
+    QueueFillSimulator sim;
+    QueueFillSimulator::FillList fills;
+
+    sim.BeginTimestamp();
+    sim.AddOrder(1, true, 100.00, 100, 0);
+    sim.AddOrder(2, true, 100.00, 100, 0);
+    sim.AddOrder(3, true, 100.00, 100, 0);
+    CHECK_EQ(sim.RemoveOrder(2), 1);
+    CHECK_EQ(sim.RemoveOrder(2), 0);
+
+    sim.OnTrade(100.00, 300, &fills);
+    CHECK_EQ(FilledSize(fills, 1), 100);
+    CHECK_EQ(FilledSize(fills, 3), 100);
+    CHECK_EQ(sim.HasRestingOrders(), 0);
+}
+
+}  // namespace
+
+int main() {
+    TradeFillsFrontToBack();
+    CancelAdvancesButNeverFills();
+    TradeBeforeDecreaseCountsOnce();
+    DecreaseBeforeTradeCountsOnce();
+    DecreaseBeforeTradeStillFills();
+    UnmatchedTradeDoesNotHideLaterCancels();
+    CrossingFillsEverything();
+    RemoveOrderUnlinks();
+
+    std::printf("queue-fill-sim-check: %s\n", g_failures ? "FAILED" : "OK");
+    return g_failures ? 1 : 0;
+}
@@ -5,6 +5,7 @@
 #include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <utility>
 #include "ExecutionTypes.h"
 #include "FillInfo.h"
 #include "IOrderTracker.h"
@@ -32,7 +33,12 @@ WobiSignalStrategy::WobiSignalStrategy(StrategyID strategyID,
       m_weight_exponent(1.0),  // default w
       m_latency_ns(0.0),       // default a
       m_position_size(1),
-      m_debug_on(true) {}
+      m_debug_on(true),
+      m_passive_entry(false),
+      m_passive_timeout_ms(1000),
+      m_batch_evaluation(false),
+      m_batch_flushes(0),
+      m_batch_rows_flushed(0) {}
 
 WobiSignalStrategy::~WobiSignalStrategy() {}
 
@@ -41,9 +47,21 @@ WobiSignalStrategy::~WobiSignalStrategy() {}
  *===========================================================*/
 
 void WobiSignalStrategy::OnResetStrategyState() {
+    // The last burst of a run has no later event to end it
+    FlushImbalanceBatch();
+    LogBatchStats();
+    m_batch_flushes = 0;
+    m_batch_rows_flushed = 0;
+
+    m_batch_slots.clear();  // points into the two maps below
     m_persistence_map.clear();
     m_last_imbalance.clear();
     m_instrument_order_id_map.clear();
+    m_queue_sims.clear();
+    m_queue_sim_times.clear();
+    m_passive_orders.clear();
+    m_imbalance_batch.Clear();
+    m_batch_entries.clear();
 }
 
 /*===========================================================
@@ -104,6 +122,23 @@ void WobiSignalStrategy::DefineStrategyParams() {
     CreateStrategyParamArgs arg8("debug", STRATEGY_PARAM_TYPE_RUNTIME,
                                  VALUE_TYPE_BOOL, m_debug_on);
     params().CreateParam(arg8);
+
+    // passive entry: rest a limit buy at the best bid instead of a market buy
+    CreateStrategyParamArgs arg9("passive_entry", STRATEGY_PARAM_TYPE_RUNTIME,
+                                 VALUE_TYPE_BOOL, m_passive_entry);
+    params().CreateParam(arg9);
+
+    // passive entry timeout (ms) before a resting limit buy is cancelled
+    CreateStrategyParamArgs arg10("passive_timeout_ms",
+                                  STRATEGY_PARAM_TYPE_RUNTIME, VALUE_TYPE_INT,
+                                  m_passive_timeout_ms);
+    params().CreateParam(arg10);
+
+    // batch evaluation of depth updates that share one adapter_time
+    CreateStrategyParamArgs arg11("batch_evaluation",
+                                  STRATEGY_PARAM_TYPE_STARTUP, VALUE_TYPE_BOOL,
+                                  m_batch_evaluation);
+    params().CreateParam(arg11);
 }
 
 /*===========================================================
@@ -148,15 +183,56 @@ void WobiSignalStrategy::OnDepth(const MarketDepthEventMsg& msg) {
     //     cout << endl;
     // }
 
+    QueueFillSimulator* sim = ActiveQueueSimulator(inst, msg.adapter_time());
+    if (sim) {
+        UpdateQueueSimulator(inst, sim);
+        LogQueueFills(inst, m_queue_fills, msg.adapter_time());
+    }
+    ManagePassiveEntry(inst, msg.adapter_time());
+
+    if (m_batch_evaluation) {
+        EnqueueImbalance(inst, msg.adapter_time());
+        return;
+    }
+
     double imbalance = ComputeWeightedImbalance(inst);
     EvaluateImbalanceSignal(inst, imbalance, msg.adapter_time());
 }
 
+void WobiSignalStrategy::OnBar(const BarEventMsg& msg) {
+    (void)msg;
+
+    // Bars bound how long a batch can wait for a new adapter_time
+    FlushImbalanceBatch();
+}
+
+void WobiSignalStrategy::OnTrade(const TradeDataEventMsg& msg) {
+    const Instrument& inst = msg.instrument();
+
+    // Any later event ends the pending depth burst
+    if (!m_imbalance_batch.empty() && msg.adapter_time() != m_batch_time) {
+        FlushImbalanceBatch();
+    }
+
+    QueueFillSimulator* sim = ActiveQueueSimulator(inst, msg.adapter_time());
+    if (!sim) {
+        return;
+    }
+
+    m_queue_fills.clear();
+    sim->OnTrade(msg.trade().price(), msg.trade().size(), &m_queue_fills);
+    LogQueueFills(inst, m_queue_fills, msg.adapter_time());
+}
+
 /*===========================================================
  *   Order Updates
  *===========================================================*/
 
 void WobiSignalStrategy::OnOrderUpdate(const OrderUpdateEventMsg& msg) {
+    // This update may change position and working orders. Rows queued after
+    // it must not chain to rows captured before it, so end the burst here.
+    FlushImbalanceBatch();
+
     const Order& order = msg.order();
     const Instrument* inst = order.instrument();
 
@@ -188,6 +264,19 @@ void WobiSignalStrategy::OnOrderUpdate(const OrderUpdateEventMsg& msg) {
         // Clear order ID tracking for this instrument
         m_instrument_order_id_map[inst] = 0;
 
+        // The order is gone at the exchange; compare the two fill models
+        // and stop modelling its queue spot
+        PassiveOrderMap::iterator passive = m_passive_orders.find(inst);
+        if (passive != m_passive_orders.end() &&
+            passive->second.order_id == order.order_id()) {
+            LogQueueComparison(*inst, passive->second, msg);
+            m_passive_orders.erase(passive);
+        }
+        QueueSimMap::iterator sim = m_queue_sims.find(inst);
+        if (sim != m_queue_sims.end()) {
+            sim->second.RemoveOrder(order.order_id());
+        }
+
         cout << "[OnOrderUpdate] Order complete for " << inst->symbol()
              << " | FinalState=" << OrderStateToString(order.order_state())
              << " | FilledQty=" << order.size_completed() << endl;
@@ -245,6 +334,15 @@ void WobiSignalStrategy::OnParamChanged(StrategyParam& param) {
     } else if (param.param_name() == "debug") {
         if (!param.Get(&m_debug_on))
             throw StrategyStudioException("Could not get debug flag");
+    } else if (param.param_name() == "passive_entry") {
+        if (!param.Get(&m_passive_entry))
+            throw StrategyStudioException("Could not get passive_entry");
+    } else if (param.param_name() == "passive_timeout_ms") {
+        if (!param.Get(&m_passive_timeout_ms))
+            throw StrategyStudioException("Could not get passive_timeout_ms");
+    } else if (param.param_name() == "batch_evaluation") {
+        if (!param.Get(&m_batch_evaluation))
+            throw StrategyStudioException("Could not get batch_evaluation");
     }
 }
 
@@ -314,20 +412,7 @@ void WobiSignalStrategy::EvaluateImbalanceSignal(const Instrument& inst,
     bool in_position = (current_position > 0);
 
     // Check for any working BUY orders on this instrument to prevent double-buying
-    bool has_working_buy = false;
-    const IOrderTracker& order_tracker = orders();
-    IOrderTracker::WorkingOrdersConstIter it =
-        order_tracker.working_orders_begin(inst_ptr);
-    IOrderTracker::WorkingOrdersConstIter end =
-        order_tracker.working_orders_end(inst_ptr);
-
-    for (; it != end; ++it) {
-        const Order* ord = *it;
-        if (ord && IsBuySide(ord->order_side())) {
-            has_working_buy = true;
-            break;
-        }
-    }
+    bool has_working_buy = HasWorkingBuy(inst);
 
     // Always log imbalance summary for diagnostics
     // cout << "[IMBALANCE] " << inst.symbol() << " | t=" << event_time
@@ -346,17 +431,10 @@ void WobiSignalStrategy::EvaluateImbalanceSignal(const Instrument& inst,
             m_persistence_map[inst_ptr] += 1;
 
             if (m_persistence_map[inst_ptr] >= m_persistence_len) {
-                cout << "\n*** BUY SIGNAL ***" << endl;
-                cout << "[SIGNAL] " << event_time << " | ACTION=BUY"
-                     << " | SYMBOL=" << inst.symbol()
-                     << " | SIZE=" << m_position_size
-                     << " | IMBALANCE=" << std::fixed << std::setprecision(4)
-                     << imbalance
-                     << " | PERSISTENCE=" << m_persistence_map[inst_ptr]
-                     << " | THRESHOLD=" << m_entry_threshold << endl;
-                cout << "*** BUY SIGNAL ***\n" << endl;
-
-                EnterLong(inst);
+                LogBuySignal(inst, imbalance, m_persistence_map[inst_ptr],
+                             event_time);
+
+                EnterLong(inst, event_time);
                 m_persistence_map[inst_ptr] = 0;  // reset after entering
             }
         } else {
@@ -400,14 +478,7 @@ void WobiSignalStrategy::EvaluateImbalanceSignal(const Instrument& inst,
 
         // Check for sell signal
         if (imbalance < m_exit_threshold) {
-            cout << "\n*** SELL SIGNAL ***" << endl;
-            cout << "[SIGNAL] " << event_time << " | ACTION=SELL"
-                 << " | SYMBOL=" << inst.symbol()
-                 << " | SIZE=" << current_position  // Sell entire position
-                 << " | IMBALANCE=" << std::fixed << std::setprecision(4)
-                 << imbalance << " | EXIT_THRESHOLD=" << m_exit_threshold
-                 << endl;
-            cout << "*** SELL SIGNAL ***\n" << endl;
+            LogSellSignal(inst, imbalance, current_position, event_time);
 
             ExitLong(inst);
             m_persistence_map[inst_ptr] = 0;
@@ -415,29 +486,238 @@ void WobiSignalStrategy::EvaluateImbalanceSignal(const Instrument& inst,
     }
 }
 
+bool WobiSignalStrategy::HasWorkingBuy(const Instrument& inst) const {
+    const IOrderTracker& order_tracker = orders();
+    IOrderTracker::WorkingOrdersConstIter it =
+        order_tracker.working_orders_begin(&inst);
+    IOrderTracker::WorkingOrdersConstIter end =
+        order_tracker.working_orders_end(&inst);
+
+    for (; it != end; ++it) {
+        const Order* ord = *it;
+        if (ord && IsBuySide(ord->order_side())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WobiSignalStrategy::LogBuySignal(const Instrument& inst, double imbalance,
+                                      int persistence,
+                                      TimeType event_time) const {
+    cout << "\n*** BUY SIGNAL ***" << endl;
+    cout << "[SIGNAL] " << event_time << " | ACTION=BUY"
+         << " | SYMBOL=" << inst.symbol() << " | SIZE=" << m_position_size
+         << " | IMBALANCE=" << std::fixed << std::setprecision(4) << imbalance
+         << " | PERSISTENCE=" << persistence
+         << " | THRESHOLD=" << m_entry_threshold << endl;
+    cout << "*** BUY SIGNAL ***\n" << endl;
+}
+
+void WobiSignalStrategy::LogSellSignal(const Instrument& inst,
+                                       double imbalance, int position,
+                                       TimeType event_time) const {
+    cout << "\n*** SELL SIGNAL ***" << endl;
+    cout << "[SIGNAL] " << event_time << " | ACTION=SELL"
+         << " | SYMBOL=" << inst.symbol()
+         << " | SIZE=" << position  // Sell entire position
+         << " | IMBALANCE=" << std::fixed << std::setprecision(4) << imbalance
+         << " | EXIT_THRESHOLD=" << m_exit_threshold << endl;
+    cout << "*** SELL SIGNAL ***\n" << endl;
+}
+
+/*===========================================================
+ *   Batched Evaluation (batch_evaluation)
+ *===========================================================*/
+
+void WobiSignalStrategy::EnqueueImbalance(const Instrument& inst,
+                                          TimeType event_time) {
+    // A batch holds one adapter_time
+    if (!m_imbalance_batch.empty() &&
+        (event_time != m_batch_time || m_imbalance_batch.full())) {
+        FlushImbalanceBatch();
+    }
+
+    // num_levels / weight_exponent are startup params; pick them up lazily.
+    // A negative num_levels means no levels, as in ComputeWeightedImbalance.
+    const int num_levels = std::max(m_num_levels, 0);
+    if (m_imbalance_batch.num_levels() != num_levels ||
+        m_imbalance_batch.weight_exponent() != m_weight_exponent) {
+        FlushImbalanceBatch();
+        m_imbalance_batch.Configure(num_levels, m_weight_exponent);
+        m_batch_bid_sizes.resize(num_levels);
+        m_batch_ask_sizes.resize(num_levels);
+
+        cout << "[BATCH] kernel=" << ImbalanceBatch::KernelName()
+             << " | levels=" << num_levels
+             << " | capacity=" << ImbalanceBatch::kCapacity << endl;
+    }
+
+    // Capture the sizes now: later messages in the burst move the book.
+    // Same level selection as ComputeWeightedImbalance.
+    const MarketModels::IAggrOrderBook& book = inst.aggregate_order_book();
+    int levels = 0;
+    if (!book.is_initializing()) {
+        levels =
+            std::min({num_levels, book.NumBidLevels(), book.NumAskLevels()});
+    }
+    for (int i = 0; i < levels; ++i) {
+        m_batch_bid_sizes[i] = book.BidSizeAtLevel(i);
+        m_batch_ask_sizes[i] = book.AskSizeAtLevel(i);
+    }
+
+    const int* bid_sizes = levels > 0 ? &m_batch_bid_sizes[0] : NULL;
+    const int* ask_sizes = levels > 0 ? &m_batch_ask_sizes[0] : NULL;
+    const int row = m_imbalance_batch.Add(bid_sizes, ask_sizes, levels);
+    m_batch_time = event_time;
+
+    BatchSlotMap::iterator it = m_batch_slots.find(&inst);
+    if (it == m_batch_slots.end()) {
+        const BatchSlot slot = {&m_persistence_map[&inst],
+                                &m_last_imbalance[&inst], -1, 0};
+        it = m_batch_slots.insert(std::make_pair(&inst, slot)).first;
+    }
+    BatchSlot& slot = it->second;
+
+    // Position state is captured now, as the per-update path would see it.
+    // A later row of the same instrument chains to the earlier one and
+    // shares its state: it only changes through order updates, which flush
+    // first.
+    if (slot.batch_id != m_batch_flushes) {
+        const BatchEntry entry = {&inst, slot.persistence,
+                                  slot.last_imbalance,
+                                  portfolio().position(&inst) > 0,
+                                  HasWorkingBuy(inst)};
+        m_imbalance_batch.SetState(row, *entry.persistence, entry.in_position,
+                                   entry.has_working_buy);
+        m_batch_entries.push_back(entry);
+    } else {
+        const BatchEntry entry = m_batch_entries[slot.row];
+        m_imbalance_batch.ChainState(row, slot.row, entry.in_position,
+                                     entry.has_working_buy);
+        m_batch_entries.push_back(entry);
+    }
+    slot.batch_id = m_batch_flushes;
+    slot.row = row;
+}
+
+void WobiSignalStrategy::FlushImbalanceBatch() {
+    if (m_imbalance_batch.empty()) {
+        return;
+    }
+
+    const int rows = m_imbalance_batch.size();
+    m_imbalance_batch.Evaluate(m_entry_threshold, m_exit_threshold,
+                               m_persistence_len);
+    ++m_batch_flushes;
+    m_batch_rows_flushed += rows;
+
+    // Store the new state and copy out the rows that produced an order
+    // action, then empty the batch before sending anything: an order update
+    // delivered from inside SendNewOrder flushes again and must find nothing.
+    struct BatchAction {
+        const Instrument* inst;
+        double imbalance;
+        int persistence;  ///< streak length that fired a BUY
+        ImbalanceBatch::Action action;
+    };
+    std::vector<BatchAction> actions;
+    const TimeType batch_time = m_batch_time;
+
+    for (int row = 0; row < rows; ++row) {
+        const BatchEntry& entry = m_batch_entries[row];
+        const double imbalance = m_imbalance_batch.imbalance(row);
+        // Rows are stored in order, so a chained row reads its
+        // predecessor's result here
+        const int persistence_before = *entry.persistence;
+
+        *entry.last_imbalance = imbalance;
+        *entry.persistence = m_imbalance_batch.persistence(row);
+
+        if (m_imbalance_batch.action(row) != ImbalanceBatch::ACTION_NONE) {
+            BatchAction pending = {entry.inst, imbalance,
+                                   persistence_before + 1,
+                                   m_imbalance_batch.action(row)};
+            actions.push_back(pending);
+        }
+    }
+
+    m_imbalance_batch.Clear();
+    m_batch_entries.clear();
+
+    for (size_t i = 0; i < actions.size(); ++i) {
+        const Instrument& inst = *actions[i].inst;
+        if (actions[i].action == ImbalanceBatch::ACTION_BUY) {
+            // A chained row keeps the state captured before an earlier row
+            // of this batch bought; don't send a second buy.
+            if (HasWorkingBuy(inst)) {
+                continue;
+            }
+            LogBuySignal(inst, actions[i].imbalance, actions[i].persistence,
+                         batch_time);
+            EnterLong(inst, batch_time);
+        } else {
+            LogSellSignal(inst, actions[i].imbalance,
+                          portfolio().position(&inst), batch_time);
+            ExitLong(inst);
+        }
+    }
+}
+
+void WobiSignalStrategy::LogBatchStats() const {
+    if (m_batch_flushes == 0) {
+        return;
+    }
+
+    cout << "[BATCH] kernel=" << ImbalanceBatch::KernelName()
+         << " | flushes=" << m_batch_flushes
+         << " | rows=" << m_batch_rows_flushed
+         << " | avg_rows=" << std::fixed << std::setprecision(2)
+         << static_cast<double>(m_batch_rows_flushed) / m_batch_flushes
+         << endl;
+}
+
 /*===========================================================
  *   Order Helpers
  *===========================================================*/
 
-void WobiSignalStrategy::EnterLong(const Instrument& inst) {
-    // Get expected fill price (best ask for buys)
+void WobiSignalStrategy::EnterLong(const Instrument& inst,
+                                   TimeType event_time) {
+    // Get expected fill price (best ask for buys). In passive mode we join
+    // the best bid; price and queue size come from the same book level.
     double expected_price = inst.top_quote().ask();
+    int visible_size = 0;
+    if (m_passive_entry) {
+        const IAggrOrderBook& book = inst.aggregate_order_book();
+        const IAggrPriceLevel* best_bid =
+            book.NumBidLevels() > 0 ? book.BidPriceLevelAtLevel(0) : NULL;
+        if (!best_bid || best_bid->price() <= 0.0) {
+            cout << "[ORDER] BUY skipped, no bid to join | Symbol="
+                 << inst.symbol() << endl;
+            return;
+        }
+        expected_price = best_bid->price();
+        visible_size = best_bid->size();
+    }
 
     cout << "[ORDER] ENTERING LONG POSITION"
          << " | Symbol=" << inst.symbol() << " | Size=" << m_position_size
          << " | Side=BUY"
          << " | TIF=GTC"
+         << " | Type=" << (m_passive_entry ? "LIMIT" : "MARKET")
          << " | ExpectedPrice=" << std::fixed << std::setprecision(2)
          << expected_price << " | LatencyNs=" << m_latency_ns << endl;
 
-    // Create order params for market buy with Good-Till-Cancelled
+    // Create order params for a market buy, or a limit buy resting at the
+    // best bid in passive mode, with Good-Till-Cancelled
     OrderParams params(
         inst, m_position_size,
-        0.0,                   // price (not used for market orders)
-        MARKET_CENTER_ID_IEX,  // default market center
+        m_passive_entry ? expected_price
+                        : 0.0,  // price (not used for market orders)
+        MARKET_CENTER_ID_IEX,   // default market center
         ORDER_SIDE_BUY,
         ORDER_TIF_GTC,  // Good Till Cancelled - stays until filled
-        ORDER_TYPE_MARKET);
+        m_passive_entry ? ORDER_TYPE_LIMIT : ORDER_TYPE_MARKET);
 
     TradeActionResult result = trade_actions()->SendNewOrder(params);
 
@@ -445,6 +725,21 @@ void WobiSignalStrategy::EnterLong(const Instrument& inst) {
         m_instrument_order_id_map[&inst] = params.order_id;
         cout << "[ORDER] BUY order sent successfully | OrderID="
              << params.order_id << endl;
+
+        if (m_passive_entry) {
+            // We join the back of the queue behind the visible bid size
+            m_queue_sims[&inst].AddOrder(params.order_id, true,
+                                         expected_price, m_position_size,
+                                         visible_size);
+
+            PassiveOrder& passive = m_passive_orders[&inst];
+            passive.order_id = params.order_id;
+            passive.price = expected_price;
+            passive.sent_time = event_time;
+            passive.cancel_sent = false;
+            passive.cancel_rejected = false;
+            passive.model_filled = false;
+        }
     } else {
         cout << "[ORDER] BUY order FAILED | Result=" << result << endl;
     }
@@ -482,7 +777,170 @@ void WobiSignalStrategy::ExitLong(const Instrument& inst) {
 }
 
 
+/*===========================================================
+ *   Queue Fill Simulation (passive entries)
+ *===========================================================*/
+
+QueueFillSimulator* WobiSignalStrategy::ActiveQueueSimulator(
+    const Instrument& inst, TimeType event_time) {
+    QueueSimMap::iterator sim = m_queue_sims.find(&inst);
+    if (sim == m_queue_sims.end() || !sim->second.HasRestingOrders()) {
+        return NULL;
+    }
+
+    // Trades and depth decreases are matched per adapter_time
+    QueueSimTimeMap::iterator last = m_queue_sim_times.find(&inst);
+    if (last == m_queue_sim_times.end() || last->second != event_time) {
+        sim->second.BeginTimestamp();
+        m_queue_sim_times[&inst] = event_time;
+    }
+    return &sim->second;
+}
+
+void WobiSignalStrategy::UpdateQueueSimulator(const Instrument& inst,
+                                              QueueFillSimulator* sim_ptr) {
+    QueueFillSimulator& sim = *sim_ptr;
+    const IAggrOrderBook& book = inst.aggregate_order_book();
+
+    m_queue_fills.clear();
+    if (book.is_initializing()) {
+        return;
+    }
+
+    // Refresh the visible size of every level we rest at. The book is
+    // sorted, so we stop as soon as we are past the price we are looking
+    // for; a level that is no longer there has size 0.
+    const int num_bids = book.NumBidLevels();
+    const int num_asks = book.NumAskLevels();
+    sim.ForEachLevelPrice(true, [&](double price) {
+        int size = 0;
+        for (int i = 0; i < num_bids; ++i) {
+            const IAggrPriceLevel* lvl = book.BidPriceLevelAtLevel(i);
+            if (!lvl || lvl->price() < price - 1e-9) {
+                break;
+            }
+            if (lvl->price() <= price + 1e-9) {
+                size = lvl->size();
+                break;
+            }
+        }
+        sim.OnLevelSize(true, price, size);
+    });
+    sim.ForEachLevelPrice(false, [&](double price) {
+        int size = 0;
+        for (int i = 0; i < num_asks; ++i) {
+            const IAggrPriceLevel* lvl = book.AskPriceLevelAtLevel(i);
+            if (!lvl || lvl->price() > price + 1e-9) {
+                break;
+            }
+            if (lvl->price() >= price - 1e-9) {
+                size = lvl->size();
+                break;
+            }
+        }
+        sim.OnLevelSize(false, price, size);
+    });
+
+    const double best_bid =
+        num_bids > 0 ? book.BidPriceLevelAtLevel(0)->price() : 0.0;
+    const double best_ask =
+        num_asks > 0 ? book.AskPriceLevelAtLevel(0)->price() : 0.0;
+    sim.OnBestPrices(best_bid, best_ask, &m_queue_fills);
+}
+
+void WobiSignalStrategy::LogQueueFills(
+    const Instrument& inst, const QueueFillSimulator::FillList& fills,
+    TimeType event_time) {
+    for (QueueFillSimulator::FillList::const_iterator it = fills.begin();
+         it != fills.end(); ++it) {
+        PassiveOrderMap::iterator passive = m_passive_orders.find(&inst);
+        if (it->leaves == 0 && passive != m_passive_orders.end() &&
+            passive->second.order_id == it->order_id) {
+            passive->second.model_filled = true;
+            passive->second.model_fill_time = event_time;
+        }
+
+        cout << "[QUEUE_FILL] " << event_time
+             << " | ACTION=" << (it->is_buy ? "BUY" : "SELL")
+             << " | Symbol=" << inst.symbol() << " | Price=" << std::fixed
+             << std::setprecision(2) << it->price << " | Size=" << it->size
+             << " | Leaves=" << it->leaves << " | OrderID=" << it->order_id
+             << endl;
+    }
+}
+
+void WobiSignalStrategy::ManagePassiveEntry(const Instrument& inst,
+                                            TimeType event_time) {
+    PassiveOrderMap::iterator it = m_passive_orders.find(&inst);
+    if (it == m_passive_orders.end() || it->second.cancel_sent) {
+        return;
+    }
+    PassiveOrder& passive = it->second;
+
+    // A rejected cancel is retried at most once per timeout period
+    if (passive.cancel_rejected &&
+        (event_time - passive.cancel_rejected_time).total_milliseconds() <
+            m_passive_timeout_ms) {
+        return;
+    }
+
+    // Reprice by cancelling: once the cancel completes has_working_buy
+    // clears and the next signal joins the new bid.
+    const IAggrOrderBook& book = inst.aggregate_order_book();
+    const IAggrPriceLevel* best_bid =
+        book.NumBidLevels() > 0 ? book.BidPriceLevelAtLevel(0) : NULL;
+    const bool bid_moved_away =
+        best_bid &&
+        QueueFillSimulator::PriceToKey(best_bid->price()) >
+            QueueFillSimulator::PriceToKey(passive.price);
+    const bool timed_out =
+        (event_time - passive.sent_time).total_milliseconds() >=
+        m_passive_timeout_ms;
+    if (!bid_moved_away && !timed_out) {
+        return;
+    }
+
+    const char* reason = bid_moved_away ? "BID_MOVED_AWAY" : "TIMEOUT";
+    TradeActionResult result =
+        trade_actions()->SendCancelOrder(passive.order_id);
+
+    if (result == TRADE_ACTION_RESULT_SUCCESSFUL) {
+        passive.cancel_sent = true;
+        cout << "[ORDER] CANCEL passive BUY sent successfully | Symbol="
+             << inst.symbol() << " | OrderID=" << passive.order_id
+             << " | Reason=" << reason << endl;
+    } else {
+        passive.cancel_rejected = true;
+        passive.cancel_rejected_time = event_time;
+        cout << "[ORDER] CANCEL passive BUY FAILED | Symbol=" << inst.symbol()
+             << " | OrderID=" << passive.order_id << " | Reason=" << reason
+             << " | Result=" << result << endl;
+    }
+}
+
+void WobiSignalStrategy::LogQueueComparison(const Instrument& inst,
+                                            const PassiveOrder& passive,
+                                            const OrderUpdateEventMsg& msg) {
+    const Order& order = msg.order();
+
+    cout << "[QUEUE_COMPARE] " << msg.update_time()
+         << " | Symbol=" << inst.symbol() << " | OrderID=" << passive.order_id
+         << " | Price=" << std::fixed << std::setprecision(2) << passive.price
+         << " | BacktesterFilledQty=" << order.size_completed()
+         << " | FinalState=" << OrderStateToString(order.order_state());
+    if (passive.model_filled) {
+        cout << " | QueueModel=FILLED@" << passive.model_fill_time;
+    } else {
+        QueueSimMap::const_iterator sim = m_queue_sims.find(&inst);
+        cout << " | QueueModel=UNFILLED | QueueAhead="
+             << (sim != m_queue_sims.end()
+                     ? sim->second.SizeAhead(passive.order_id)
+                     : -1);
+    }
+    cout << endl;
+}
+
+
 // if (m_debug_on && weighted_total == 0.0) {
 //     cout << "[WOBI] Empty depth for " << inst.symbol() << endl;
 // }
-
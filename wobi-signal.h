@@ -18,6 +18,9 @@
 #include <Strategy.h>
 #include <Utilities/ParseConfig.h>
 
+#include "imbalance-batch.h"
+#include "queue-fill-sim.h"
+
 #include <boost/unordered_map.hpp>
 #include <cstring>
 #include <iostream>
@@ -41,6 +44,17 @@
  *   - Sell (GTC): when portfolio position > 0 AND I < exit_threshold.
  *   - Position gating: uses portfolio() as single source of truth.
  *   - Prevents double-buying by checking for working buy orders.
+ *   - passive_entry: join the best bid with a limit order instead of
+ *                    crossing the spread. The order is cancelled once the
+ *                    bid moves above it or after passive_timeout_ms.
+ *                    A QueueFillSimulator tracks our queue position from
+ *                    depth/trade events and logs the fills it models as
+ *                    [QUEUE_FILL]. It only reports: positions and working
+ *                    orders still follow the backtester's own fill model.
+ *                    Each passive order ends with a [QUEUE_COMPARE] line
+ *                    putting the two models side by side.
+ *   - batch_evaluation: evaluate same-adapter_time depth bursts together
+ *                       (see README, "Batched Evaluation").
  */
 class WobiSignalStrategy : public RCM::StrategyStudio::Strategy {
    public:
@@ -51,6 +65,51 @@ class WobiSignalStrategy : public RCM::StrategyStudio::Strategy {
         const RCM::StrategyStudio::MarketModels::Instrument*, double>
         ImbalanceMap;
     typedef boost::unordered_map<std::string, double> TradePriceMap;
+    typedef boost::unordered_map<
+        const RCM::StrategyStudio::MarketModels::Instrument*,
+        QueueFillSimulator>
+        QueueSimMap;
+    typedef boost::unordered_map<
+        const RCM::StrategyStudio::MarketModels::Instrument*,
+        RCM::StrategyStudio::TimeType>
+        QueueSimTimeMap;
+
+    /** A resting passive entry order and its queue-model outcome. */
+    struct PassiveOrder {
+        RCM::StrategyStudio::OrderID order_id;
+        double price;
+        RCM::StrategyStudio::TimeType sent_time;
+        bool cancel_sent;
+        RCM::StrategyStudio::TimeType cancel_rejected_time;  ///< last reject
+        bool cancel_rejected;  ///< retry only after m_passive_timeout_ms
+        bool model_filled;  ///< queue model filled it completely
+        RCM::StrategyStudio::TimeType model_fill_time;
+    };
+    typedef boost::unordered_map<
+        const RCM::StrategyStudio::MarketModels::Instrument*, PassiveOrder>
+        PassiveOrderMap;
+
+    /** An instrument's place in the batch. Kept across flushes, so an
+     *  enqueue is one lookup and no allocation. The pointers are into
+     *  m_persistence_map and m_last_imbalance (map nodes do not move). */
+    struct BatchSlot {
+        int* persistence;
+        double* last_imbalance;
+        long long batch_id;  ///< m_batch_flushes when row was added
+        int row;             ///< latest row of the instrument in that batch
+    };
+    typedef boost::unordered_map<
+        const RCM::StrategyStudio::MarketModels::Instrument*, BatchSlot>
+        BatchSlotMap;
+
+    /** A pending batch row; written back by pointer on flush. */
+    struct BatchEntry {
+        const RCM::StrategyStudio::MarketModels::Instrument* inst;
+        int* persistence;
+        double* last_imbalance;
+        bool in_position;      ///< portfolio position > 0 at enqueue
+        bool has_working_buy;  ///< HasWorkingBuy() at enqueue
+    };
 
    public:
     WobiSignalStrategy(RCM::StrategyStudio::StrategyID strategyID,
@@ -62,11 +121,11 @@ class WobiSignalStrategy : public RCM::StrategyStudio::Strategy {
     // IEventCallback interface
     //
    public:
-    // virtual void OnTrade(const RCM::StrategyStudio::TradeDataEventMsg& msg);
+    virtual void OnTrade(const RCM::StrategyStudio::TradeDataEventMsg& msg);
     // virtual void OnTopQuote(const RCM::StrategyStudio::QuoteEventMsg& msg);
     // virtual void OnQuote(const RCM::StrategyStudio::QuoteEventMsg& msg);
     virtual void OnDepth(const RCM::StrategyStudio::MarketDepthEventMsg& msg);
-    // virtual void OnBar(const RCM::StrategyStudio::BarEventMsg& msg);
+    virtual void OnBar(const RCM::StrategyStudio::BarEventMsg& msg);
 
     // virtual void OnMarketState(
     //     const RCM::StrategyStudio::MarketStateEventMsg& msg) {};
@@ -103,10 +162,63 @@ class WobiSignalStrategy : public RCM::StrategyStudio::Strategy {
         const RCM::StrategyStudio::MarketModels::Instrument& inst,
         double imbalance, RCM::StrategyStudio::TimeType event_time);
 
+    /** True if a BUY order is working for the instrument. */
+    bool HasWorkingBuy(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst) const;
+
+    /** Signal banners shared by the scalar and batched paths. */
+    void LogBuySignal(const RCM::StrategyStudio::MarketModels::Instrument& inst,
+                      double imbalance, int persistence,
+                      RCM::StrategyStudio::TimeType event_time) const;
+    void LogSellSignal(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst,
+        double imbalance, int position,
+        RCM::StrategyStudio::TimeType event_time) const;
+
+    /** Queue an instrument's book sizes into the pending batch. */
+    void EnqueueImbalance(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst,
+        RCM::StrategyStudio::TimeType event_time);
+
+    /** Evaluate the pending batch and dispatch its order actions. */
+    void FlushImbalanceBatch();
+
+    /** Log the kernel and the average flushed batch size so far. */
+    void LogBatchStats() const;
+
     /** Convenience wrappers for entering / exiting a long position. */
-    void EnterLong(const RCM::StrategyStudio::MarketModels::Instrument& inst);
+    void EnterLong(const RCM::StrategyStudio::MarketModels::Instrument& inst,
+                   RCM::StrategyStudio::TimeType event_time);
     void ExitLong(const RCM::StrategyStudio::MarketModels::Instrument& inst);
 
+    /** Queue simulator for inst if it has resting orders, else NULL.
+     *  Starts a new simulator timestamp when event_time changes. */
+    QueueFillSimulator* ActiveQueueSimulator(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst,
+        RCM::StrategyStudio::TimeType event_time);
+
+    /** Feed the latest book state to the instrument's queue simulator. */
+    void UpdateQueueSimulator(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst,
+        QueueFillSimulator* sim);
+
+    /** Log fills reported by the queue simulator and record full fills. */
+    void LogQueueFills(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst,
+        const QueueFillSimulator::FillList& fills,
+        RCM::StrategyStudio::TimeType event_time);
+
+    /** Cancel a passive entry once the bid moves away or it times out. */
+    void ManagePassiveEntry(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst,
+        RCM::StrategyStudio::TimeType event_time);
+
+    /** Log how the queue model and the backtester handled an order. */
+    void LogQueueComparison(
+        const RCM::StrategyStudio::MarketModels::Instrument& inst,
+        const PassiveOrder& passive,
+        const RCM::StrategyStudio::OrderUpdateEventMsg& msg);
+
     //
     // Strategy parameters (configurable from Strategy Manager)
     //
@@ -119,6 +231,9 @@ class WobiSignalStrategy : public RCM::StrategyStudio::Strategy {
 
     int m_position_size;  ///< order size when entering/exiting
     bool m_debug_on;      ///< enable/disable verbose logging
+    bool m_passive_entry;  ///< join the bid instead of crossing the spread
+    int m_passive_timeout_ms;  ///< cancel a resting passive entry after this
+    bool m_batch_evaluation;  ///< batch same-timestamp depth updates
 
     //
     // Per-instrument state
@@ -130,6 +245,23 @@ class WobiSignalStrategy : public RCM::StrategyStudio::Strategy {
                          RCM::StrategyStudio::OrderID>
         m_instrument_order_id_map;
 
+    QueueSimMap m_queue_sims;  ///< queue position model per instrument
+    QueueSimTimeMap m_queue_sim_times;  ///< last event time fed to each
+    PassiveOrderMap m_passive_orders;   ///< resting passive entry orders
+    QueueFillSimulator::FillList m_queue_fills;  ///< scratch fill buffer
+
+    //
+    // Batched evaluation state (batch_evaluation)
+    //
+    ImbalanceBatch m_imbalance_batch;  ///< pending rows for m_batch_time
+    std::vector<BatchEntry> m_batch_entries;  ///< one per batch row
+    BatchSlotMap m_batch_slots;               ///< instrument -> its slot
+    RCM::StrategyStudio::TimeType m_batch_time;  ///< adapter_time of batch
+    std::vector<int> m_batch_bid_sizes;  ///< scratch level sizes
+    std::vector<int> m_batch_ask_sizes;  ///< scratch level sizes
+    long long m_batch_flushes;  ///< non-empty flushes; id of pending batch
+    long long m_batch_rows_flushed;  ///< rows over all flushes
+
     //   inline void DBG(const std::string& s) const {
     //     if (m_debug_on) {
     //         std::cout << s << std::endl;